@@ -0,0 +1,109 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef AGENT_CONFIG_HPP_
+#define AGENT_CONFIG_HPP_
+
+#include <chrono>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+ * @struct AgentConfig
+ * @brief Configuration of the agent read from the config file.
+ *
+ * A loaded configuration is never modified: reloading the file creates a new snapshot
+ * that replaces the previous one as a whole.
+ */
+struct AgentConfig
+{
+  // Identity and broker address, only read at startup
+  int agent_id = 0;
+  std::string agent_name;
+  std::string robot_name;
+  std::string server_address;
+  std::string client_id;
+
+  // Broker credentials, used on the next (re)connection
+  std::string server_username;
+  std::string server_password;
+
+  // Topics to subscribe
+  std::vector<std::string> topics;
+
+  // Building description loaded at startup, relative paths are resolved from the config file
+  std::string topology_file;
+
+  // Liveness timeout per sensor type, the empty type is the default
+  std::map<std::string, std::chrono::milliseconds> stale_timeouts;
+  // Sensor type names sent by the sensors mapped to the types supported by the agent
+  std::map<std::string, std::string> sensor_types;
+  // Validity thresholds of the readings
+  std::map<std::string, float> thresholds;
+
+  // Statistics and tracing
+  std::chrono::seconds stats_period{0};
+  unsigned int trace_sample_rate = 0;
+  std::string trace_file = "mqtt_dsr_agent_trace.json";
+
+  // DSR -> MQTT change streaming
+  std::string publish_topic;
+  std::set<std::string> publish_node_types;
+  std::set<std::string> publish_attributes;
+  std::chrono::milliseconds publish_period{1000};
+
+  // Retained sensor snapshot
+  std::string snapshot_topic;
+  std::chrono::milliseconds snapshot_period{1000};
+
+  /**
+   * @brief Get the liveness timeout of a sensor type.
+   *
+   * @param sensor_type Type of the sensor.
+   * @return Timeout of the type, the default timeout if not set or zero if disabled.
+   */
+  std::chrono::milliseconds stale_timeout(const std::string & sensor_type) const;
+
+  /**
+   * @brief Get the type supported by the agent for a sensor type name.
+   *
+   * @param name Type name sent by the sensor.
+   * @return Mapped type, or the same name if it is not mapped.
+   */
+  std::string sensor_type(const std::string & name) const;
+
+  /**
+   * @brief Get a threshold.
+   *
+   * @param name Name of the threshold.
+   * @param default_value Value returned if the threshold is not set.
+   * @return Value of the threshold.
+   */
+  float threshold(const std::string & name, float default_value) const;
+};
+
+/**
+ * @brief Read the configuration from a file.
+ *
+ * @param config_file Path of the config file.
+ * @return Configuration, or nullptr if the file could not be read or has errors.
+ */
+std::shared_ptr<const AgentConfig> load_configuration(const std::string & config_file);
+
+#endif  // AGENT_CONFIG_HPP_
@@ -18,17 +18,30 @@
 #ifndef MQTT_AGENT_HPP_
 #define MQTT_AGENT_HPP_
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 // Qt
+#include <QFileSystemWatcher>
 #include <QObject>
+#include <QTimer>
 
 #include "dsr/api/dsr_api.h"
 #include "mqtt/async_client.h"
 
+#include "mqtt_dsr_agent/agent_config.hpp"
 #include "mqtt_dsr_agent/json_messages.hpp"
+#include "mqtt_dsr_agent/timing_wheel.hpp"
+#include "mqtt_dsr_agent/tracer.hpp"
+
+// Attribute set to true when a sensor has stopped publishing for longer than its timeout
+REGISTER_TYPE(sensor_offline, bool, false)
 
 /**
  * @class MqttAgent
@@ -62,6 +75,7 @@ public:
 
   /**
    * @brief Set the credentials for the MQTT broker.
+   * It must be called before connect(). Credentials in the configuration take precedence.
    *
    * @param username Username.
    * @param password Password.
@@ -80,6 +94,108 @@ public:
    */
   void disconnect();
 
+  /**
+   * @brief Create the rooms, sensors and parent relations of a topology file
+   * that are missing in the DSR graph.
+   *
+   * @param topology_file JSON file with 'rooms' and 'sensors' arrays.
+   * @return true if the file was loaded.
+   */
+  bool load_topology(const std::string & topology_file);
+
+  /**
+   * @brief Create a room node if it is not in the DSR graph.
+   *
+   * @param room_name Name of the room.
+   * @return true if the room is in the graph.
+   */
+  bool add_room(const std::string & room_name);
+
+  /**
+   * @brief Apply a configuration at runtime.
+   *
+   * The configuration replaces the previous one as a whole: messages being processed keep the
+   * snapshot they started with. Identity and broker address changes need a restart.
+   *
+   * @param config Configuration to apply.
+   */
+  void apply_configuration(std::shared_ptr<const AgentConfig> config);
+
+  /**
+   * @brief Get the current configuration.
+   *
+   * @return Snapshot of the current configuration.
+   */
+  std::shared_ptr<const AgentConfig> configuration() const;
+
+  /**
+   * @brief Reload and apply the configuration file whenever it changes.
+   *
+   * @param config_file Path of the config file.
+   */
+  void watch_configuration(const std::string & config_file);
+
+  /**
+   * @brief Request a reload of the configuration file. It is async-signal-safe,
+   * the file is reloaded from the Qt event loop.
+   */
+  void request_reload() {reload_requested_ = true;}
+
+  /**
+   * @brief Set the period to report the ingest throughput and latency.
+   *
+   * @param period Report period. Zero disables the report.
+   */
+  void set_stats_period(std::chrono::seconds period);
+
+  /**
+   * @brief Publish the changes of the DSR graph to the MQTT broker.
+   *
+   * Changes are batched and published every flush period as one message with the attributes
+   * that changed since the last message. Attributes written by this agent are not published.
+   *
+   * @param topic Topic to publish. An empty topic disables the streaming.
+   * @param node_types Types of the nodes to publish. Empty to publish every type.
+   * @param attributes Names of the attributes to publish. Empty to publish every attribute.
+   * @param flush_period Period between messages.
+   */
+  void set_change_streaming(
+    const std::string & topic, const std::set<std::string> & node_types,
+    const std::set<std::string> & attributes, std::chrono::milliseconds flush_period);
+
+  /**
+   * @brief Publish the state of the sensors managed by the agent as retained messages.
+   *
+   * Each sensor whose readings changed is published to topic/sensor_name, and the aggregate
+   * of all the sensors to topic, at most once per period. A new topic starts from the sensor
+   * nodes already in the graph.
+   *
+   * @param topic Base topic of the snapshot. An empty topic disables the snapshot.
+   * @param period Minimum period between aggregate messages.
+   */
+  void set_snapshot(const std::string & topic, std::chrono::milliseconds period);
+
+  /**
+   * @brief Configure the tracing of the message pipeline.
+   *
+   * @param sample_rate Trace one out of every sample_rate messages. Zero disables the tracing.
+   * @param trace_file Chrome trace JSON file where the spans are dumped.
+   */
+  void set_tracing(unsigned int sample_rate, const std::string & trace_file);
+
+  /**
+   * @brief Request a dump of the traced spans to the trace file.
+   * It is async-signal-safe, the dump is written from the Qt event loop.
+   */
+  void request_trace_dump() {tracer_.request_dump();}
+
+  /**
+   * @brief Dump the traced spans to the trace file.
+   *
+   * @return true if the file was written.
+   */
+  bool dump_trace();
+
   /**
    * @brief Set the topics to subscribe.
    *
@@ -143,14 +259,140 @@ private:
   void edge_deleted(std::uint64_t from, std::uint64_t to, const std::string & edge_tag);
 
   /**
-   * @brief Update the attributes of the given node in the DSR graph.
+   * @brief Sensor node whose attributes have been modified but not yet updated in the graph.
+   */
+  struct PendingSensorUpdate
+  {
+    DSR::Node node;
+    std::string type;
+    // Sensor timestamp, if the reading carried one
+    std::optional<long long int> timestamp;
+  };
+  using SensorBatch = std::map<std::string, PendingSensorUpdate>;
+
+  /**
+   * @brief Update the attributes of the given node and stage it in a batch.
    *
    * @param data JSON containing sensor data to update to the node
-   * @result 1: data successfully updaten in the DSR. 0: error uploading data
+   * @param batch Batch where the updated node is staged, keyed by sensor name
+   * @result 1: data successfully staged. 0: error parsing data
+   */
+  int sensor_data_to_dsr(const json & data, SensorBatch & batch);
+
+  /**
+   * @brief Update in the DSR graph every node staged in a batch, once per sensor.
+   *
+   * @param batch Batch of staged nodes. It is empty on return.
+   */
+  void commit_sensor_batch(SensorBatch & batch);
+
+  /**
+   * @brief Rearm the liveness deadline of a sensor after receiving its data.
+   *
+   * @param sensor_name Name of the sensor node.
+   * @param sensor_type Type of the sensor.
    */
-  int sensor_data_to_dsr(json data);
+  void refresh_liveness(const std::string & sensor_name, const std::string & sensor_type);
+
+  /**
+   * @brief Advance the liveness wheel and mark the expired sensors as offline.
+   */
+  void check_stale_sensors();
+
+  /**
+   * @brief Reload the watched configuration file. The current configuration is kept on errors.
+   */
+  void reload_configuration();
+
+  /**
+   * @brief Get the topics to subscribe with a configuration.
+   *
+   * @param config Configuration.
+   * @return Topics of the configuration, or the topic given to the constructor if it has none.
+   */
+  std::vector<std::string> subscription_topics(const AgentConfig & config) const;
+
+  /**
+   * @brief Get the topic of the control messages sent to the sensors.
+   *
+   * @return Control subtopic of the first subscribed topic of the current configuration.
+   */
+  std::string control_topic() const;
+
+  /**
+   * @brief Subscribe to the added topics and unsubscribe from the removed ones.
+   *
+   * @param previous Topics of the previous configuration.
+   * @param current Topics of the new configuration.
+   */
+  void update_subscriptions(
+    const std::vector<std::string> & previous, const std::vector<std::string> & current);
+
+  /**
+   * @brief Record the latency from the sensor timestamp to the DSR commit.
+   *
+   * @param timestamp Timestamp of the sample (EPOCH time in nanoseconds).
+   */
+  void record_commit_latency(long long int timestamp);
+
+  /**
+   * @brief Record the commit of a sensor node and its latency from the sensor timestamp.
+   *
+   * @param sensor_name Name of the sensor node.
+   * @param timestamp Timestamp of the sample (EPOCH time in nanoseconds), if the sensor sent it.
+   */
+  void record_commit(
+    const std::string & sensor_name, const std::optional<long long int> & timestamp);
+
+  /**
+   * @brief Record a message that could not be uploaded in the DSR.
+   */
+  void record_drop();
+
+  /**
+   * @brief Print the throughput and p50/p99 commit latency since the last report.
+   */
+  void report_stats();
+
+  /**
+   * @brief Print the provisioned sensors that have not published yet, if any.
+   */
+  void report_steady_state();
+
+  /**
+   * @brief Publish the attributes changed in the nodes updated since the last call.
+   */
+  void publish_graph_changes();
+
+  /**
+   * @brief Update the snapshot of a sensor and mark it to be published if its readings changed.
+   *
+   * @param sensor_name Name of the sensor node.
+   * @param node Sensor node with its current attributes.
+   */
+  void update_snapshot(const std::string & sensor_name, const DSR::Node & node);
+
+  /**
+   * @brief Publish the snapshot of the changed sensors and the aggregate of all the sensors.
+   */
+  void publish_snapshot();
+
+  /**
+   * @brief Convert the value of a DSR attribute to JSON.
+   *
+   * @param attribute DSR attribute.
+   * @return Value of the attribute.
+   */
+  static json attribute_to_json(const DSR::Attribute & attribute);
   /* ----------------------------------------  MQTT  -------------------- -------------------- */
 
+  /**
+   * @brief Build the connection options with the credentials of the current configuration.
+   *
+   * @return Options to connect to the broker.
+   */
+  mqtt::connect_options connection_options() const;
+
   /**
    * @brief Reconnect to the broker manually by calling connect() again.
    *
@@ -206,21 +448,71 @@ private:
   const int QOS = 1;
   // Number of connection retries
   const int N_RETRY_ATTEMPTS = 5;
+  // Time after startup to report the provisioned sensors that have not published yet
+  const std::chrono::seconds STEADY_STATE_TIMEOUT{60};
 
-  // MQTT topic
+  // Topic subscribed when the configuration has none
   std::string topic_;
   
   // The MQTT client
   std::string server_address_;
   std::string client_id_;
   mqtt::async_client client_;
-  // Options to use if we need to reconnect
+  // Base options to use if we need to reconnect, not modified once connected
   mqtt::connect_options conn_options_;
 
   std::optional<DSR::Node> person_node_; 
   std::optional<DSR::Node> radar_sensor_node_;   
   //std::optional<DSR::Node> parent_node_;
   bool control_;
+
+  // Liveness deadlines of the sensors, advanced by the stale timer
+  TimingWheel liveness_wheel_;
+  std::mutex liveness_mutex_;
+  // Serializes the sensor commits with the offline marking, taken before liveness_mutex_
+  std::mutex sensor_commit_mutex_;
+  QTimer stale_timer_;
+
+  // Ingest statistics, reported by the stats timer
+  std::mutex stats_mutex_;
+  bool stats_enabled_ = false;
+  std::size_t committed_messages_ = 0;
+  std::vector<long long int> commit_latencies_;
+  std::chrono::steady_clock::time_point stats_start_;
+  std::chrono::steady_clock::time_point startup_time_;
+  std::set<std::string> unseen_sensors_;
+  std::size_t dropped_messages_ = 0;
+  QTimer stats_timer_;
+  QTimer steady_state_timer_;
+
+  // Pipeline tracing
+  Tracer tracer_;
+  std::string trace_file_ = "mqtt_dsr_agent_trace.json";
+
+  // Configuration snapshot, replaced as a whole on reload
+  mutable std::mutex config_mutex_;
+  std::shared_ptr<const AgentConfig> config_;
+  std::string config_file_;
+  QFileSystemWatcher config_watcher_;
+  std::atomic<bool> reload_requested_{false};
+
+  // Serves the requests made from signal handlers (trace dumps and reloads)
+  QTimer request_timer_;
+
+  // DSR -> MQTT change streaming, only touched from the Qt event loop
+  std::string publish_topic_;
+  std::set<std::string> publish_node_types_;
+  std::set<std::string> publish_attributes_;
+  std::set<std::uint64_t> dirty_nodes_;
+  std::map<std::uint64_t, json> published_attributes_;
+  QTimer publish_timer_;
+
+  // Retained snapshot of the sensors, updated from the MQTT and Qt threads
+  std::mutex snapshot_mutex_;
+  std::string snapshot_topic_;
+  std::map<std::string, json> snapshot_;
+  std::set<std::string> dirty_sensors_;
+  QTimer snapshot_timer_;
 };
 
 #endif  // MQTT_AGENT_HPP_
@@ -0,0 +1,133 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TIMING_WHEEL_HPP_
+#define TIMING_WHEEL_HPP_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class TimingWheel
+ * @brief Hierarchical timing wheel that keeps one deadline per key.
+ *
+ * Scheduling, rescheduling and cancelling a key are O(1). Advancing the wheel costs O(1) per
+ * elapsed tick plus the number of expired or cascaded entries. The class is not thread-safe.
+ */
+class TimingWheel
+{
+public:
+  /**
+   * @brief Construct a new Timing Wheel object.
+   *
+   * @param resolution Duration of one tick of the lowest level.
+   */
+  explicit TimingWheel(std::chrono::milliseconds resolution);
+
+  /**
+   * @brief Schedule (or reschedule) the deadline of a key.
+   *
+   * @param key Identifier of the deadline.
+   * @param timeout Time from now until the deadline expires.
+   */
+  void schedule(const std::string & key, std::chrono::milliseconds timeout);
+
+  /**
+   * @brief Cancel the deadline of a key.
+   *
+   * @param key Identifier of the deadline.
+   * @return true if the key had a pending deadline.
+   */
+  bool cancel(const std::string & key);
+
+  /**
+   * @brief Check if a key has a pending deadline.
+   *
+   * @param key Identifier of the deadline.
+   * @return true if the key has a pending deadline.
+   */
+  bool contains(const std::string & key) const;
+
+  /**
+   * @brief Advance the wheel up to the given time.
+   *
+   * @param now Current time.
+   * @return Keys whose deadline has expired. They are removed from the wheel.
+   */
+  std::vector<std::string> advance(std::chrono::steady_clock::time_point now);
+
+  /**
+   * @brief Get the number of pending deadlines.
+   *
+   * @return Number of pending deadlines.
+   */
+  std::size_t size() const {return index_.size();}
+
+  /**
+   * @brief Get the duration of one tick.
+   *
+   * @return Duration of one tick.
+   */
+  std::chrono::milliseconds resolution() const {return resolution_;}
+
+private:
+  static constexpr std::size_t SLOT_BITS = 6;
+  static constexpr std::size_t SLOTS = 1 << SLOT_BITS;
+  static constexpr std::size_t LEVELS = 4;
+  static constexpr std::uint64_t MAX_TICKS = (1ULL << (SLOT_BITS * LEVELS)) - 1;
+
+  struct Entry
+  {
+    std::string key;
+    std::uint64_t expiry;
+  };
+  using Slot = std::list<Entry>;
+
+  struct Location
+  {
+    std::size_t level;
+    std::size_t slot;
+    Slot::iterator it;
+  };
+
+  /**
+   * @brief Place an entry in the level and slot that match its expiry tick.
+   *
+   * @param entry Entry to insert.
+   */
+  void insert(Entry entry);
+
+  /**
+   * @brief Move the entries of a slot of an upper level to the lower levels.
+   *
+   * @param level Level of the slot.
+   * @param slot Index of the slot.
+   */
+  void cascade(std::size_t level, std::size_t slot);
+
+  std::chrono::milliseconds resolution_;
+  std::chrono::steady_clock::time_point start_;
+  std::uint64_t current_tick_;
+  std::array<std::array<Slot, SLOTS>, LEVELS> wheels_;
+  std::unordered_map<std::string, Location> index_;
+};
+
+#endif  // TIMING_WHEEL_HPP_
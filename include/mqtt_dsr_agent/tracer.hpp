@@ -0,0 +1,173 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef TRACER_HPP_
+#define TRACER_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class Tracer
+ * @brief Sampled span tracer writing to per-thread ring buffers.
+ *
+ * A message is sampled on the thread that handles it with begin_sample(). Every TraceSpan
+ * created on that thread until the next begin_sample() is recorded in the thread's ring buffer,
+ * overwriting the oldest spans when it is full. The buffers are dumped as Chrome trace JSON,
+ * which can be opened with chrome://tracing or https://ui.perfetto.dev.
+ */
+class Tracer
+{
+public:
+  /**
+   * @brief Construct a new Tracer object.
+   *
+   * @param capacity Number of spans kept per thread.
+   */
+  explicit Tracer(std::size_t capacity = 65536);
+
+  /**
+   * @brief Set how many messages are traced.
+   *
+   * @param rate Trace one out of every rate messages. Zero disables the tracing.
+   */
+  void set_sample_rate(unsigned int rate) {sample_rate_ = rate;}
+
+  /**
+   * @brief Decide whether the message handled now by the calling thread is traced.
+   *
+   * @return true if the message is traced.
+   */
+  bool begin_sample();
+
+  /**
+   * @brief Check if the message handled by the calling thread is traced.
+   *
+   * @return true if the message is traced.
+   */
+  bool sampling() const;
+
+  /**
+   * @brief Record a span in the ring buffer of the calling thread.
+   *
+   * @param name Name of the span. It must be a string literal.
+   * @param start_ns Start time (EPOCH time in nanoseconds).
+   * @param end_ns End time (EPOCH time in nanoseconds).
+   */
+  void record(const char * name, std::int64_t start_ns, std::int64_t end_ns);
+
+  /**
+   * @brief Request a dump of the buffers. It is async-signal-safe.
+   */
+  void request_dump() {dump_requested_ = true;}
+
+  /**
+   * @brief Check and clear a pending dump request.
+   *
+   * @return true if a dump was requested.
+   */
+  bool take_dump_request() {return dump_requested_.exchange(false);}
+
+  /**
+   * @brief Write the spans of every thread to a Chrome trace JSON file.
+   *
+   * @param path Path of the file.
+   * @return true if the file was written.
+   */
+  bool dump(const std::string & path);
+
+  /**
+   * @brief Get the current time in the clock used by the spans.
+   *
+   * @return EPOCH time in nanoseconds.
+   */
+  static std::int64_t now_ns();
+
+private:
+  struct Event
+  {
+    const char * name;
+    std::int64_t start_ns;
+    std::int64_t duration_ns;
+  };
+
+  struct ThreadBuffer
+  {
+    // Only contended while dumping
+    std::mutex mutex;
+    std::vector<Event> events;
+    std::size_t next = 0;
+    bool wrapped = false;
+    std::uint32_t tid;
+  };
+
+  /**
+   * @brief Get the buffer of the calling thread, creating it on first use.
+   *
+   * @return Buffer of the calling thread.
+   */
+  ThreadBuffer & thread_buffer();
+
+  std::size_t capacity_;
+  std::atomic<unsigned int> sample_rate_;
+  std::atomic<std::uint64_t> sample_counter_;
+  std::atomic<bool> dump_requested_;
+  std::mutex buffers_mutex_;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+};
+
+/**
+ * @class TraceSpan
+ * @brief Scoped span recorded when it goes out of scope if the current message is sampled.
+ */
+class TraceSpan
+{
+public:
+  /**
+   * @brief Start a span.
+   *
+   * @param tracer Tracer where the span is recorded.
+   * @param name Name of the span. It must be a string literal.
+   */
+  TraceSpan(Tracer & tracer, const char * name)
+  : tracer_(tracer), name_(name), active_(tracer.sampling()),
+    start_ns_(active_ ? Tracer::now_ns() : 0) {}
+
+  /**
+   * @brief Finish the span.
+   */
+  ~TraceSpan()
+  {
+    if (active_) {
+      tracer_.record(name_, start_ns_, Tracer::now_ns());
+    }
+  }
+
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan & operator=(const TraceSpan &) = delete;
+
+private:
+  Tracer & tracer_;
+  const char * name_;
+  bool active_;
+  std::int64_t start_ns_;
+};
+
+#endif  // TRACER_HPP_
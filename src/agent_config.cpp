@@ -0,0 +1,169 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "mqtt_dsr_agent/agent_config.hpp"
+
+namespace
+{
+// Comma separated list of values
+std::vector<std::string> split_list(const std::string & list)
+{
+  std::vector<std::string> values;
+  std::istringstream is_list(list);
+  std::string value;
+  while (std::getline(is_list, value, ',')) {
+    if (!value.empty()) {
+      values.push_back(value);
+    }
+  }
+  return values;
+}
+
+// Suffix of a '<prefix>.<suffix>' key, or empty if the key is just '<prefix>'
+bool match_prefix(const std::string & key, const std::string & prefix, std::string & suffix)
+{
+  if (key == prefix) {
+    suffix.clear();
+    return true;
+  }
+  if (key.rfind(prefix + ".", 0) == 0) {
+    suffix = key.substr(prefix.size() + 1);
+    return true;
+  }
+  return false;
+}
+}  // namespace
+
+std::chrono::milliseconds AgentConfig::stale_timeout(const std::string & sensor_type) const
+{
+  auto timeout = stale_timeouts.find(sensor_type);
+  if (timeout == stale_timeouts.end()) {
+    timeout = stale_timeouts.find("");
+  }
+  return timeout != stale_timeouts.end() ? timeout->second : std::chrono::milliseconds(0);
+}
+
+std::string AgentConfig::sensor_type(const std::string & name) const
+{
+  auto type = sensor_types.find(name);
+  return type != sensor_types.end() ? type->second : name;
+}
+
+float AgentConfig::threshold(const std::string & name, float default_value) const
+{
+  auto value = thresholds.find(name);
+  return value != thresholds.end() ? value->second : default_value;
+}
+
+std::shared_ptr<const AgentConfig> load_configuration(const std::string & config_file)
+{
+  auto config = std::make_shared<AgentConfig>();
+  // Open config file
+  std::ifstream configFile(config_file);
+  if (!configFile.is_open()) {
+    std::cerr << "Couldn't open config file: " << config_file << std::endl;
+    return nullptr;
+  }
+  // Read lines from config file and parse the parameters
+  std::string line;
+  std::cout << "Configuration parameters:";
+  while (std::getline(configFile, line)) {
+    if (line.empty() || line[0] == '#') {
+      continue;
+    }
+    std::istringstream is_line(line);
+    std::string key, value, suffix;
+    if (!std::getline(is_line, key, '=')) {
+      continue;
+    }
+    std::getline(is_line, value);
+    try {
+      if (key == "agent_id") {
+        config->agent_id = std::stoi(value);
+      } else if (key == "agent_name") {
+        config->agent_name = value;
+      } else if (key == "robot_name") {
+        config->robot_name = value;
+      } else if (key == "server_address") {
+        config->server_address = value;
+      } else if (key == "client_id") {
+        config->client_id = value;
+      } else if (key == "topic" || key == "topics") {
+        for (const auto & topic : split_list(value)) {
+          config->topics.push_back(topic);
+        }
+      } else if (key == "parent_node" || key == "sensor_name") {
+        // Legacy parameters, no longer used
+      } else if (key == "server_username") {
+        config->server_username = value;
+      } else if (key == "server_password") {
+        config->server_password = value;
+      } else if (key == "topology_file") {
+        // Relative to the directory of the config file
+        std::filesystem::path topology_file(value);
+        if (topology_file.is_relative()) {
+          topology_file = std::filesystem::path(config_file).parent_path() / topology_file;
+        }
+        config->topology_file = topology_file.string();
+      } else if (key == "stats_period") {
+        config->stats_period = std::chrono::seconds(std::stoi(value));
+      } else if (key == "trace_sample_rate") {
+        config->trace_sample_rate = static_cast<unsigned int>(std::stoul(value));
+      } else if (key == "trace_file") {
+        config->trace_file = value;
+      } else if (key == "publish_topic") {
+        config->publish_topic = value;
+      } else if (key == "publish_node_types") {
+        for (const auto & type : split_list(value)) {
+          config->publish_node_types.insert(type);
+        }
+      } else if (key == "publish_attributes") {
+        for (const auto & attribute : split_list(value)) {
+          config->publish_attributes.insert(attribute);
+        }
+      } else if (key == "publish_period") {
+        config->publish_period = std::chrono::milliseconds(std::stoi(value));
+      } else if (key == "snapshot_topic") {
+        config->snapshot_topic = value;
+      } else if (key == "snapshot_period") {
+        config->snapshot_period = std::chrono::milliseconds(std::stoi(value));
+      } else if (match_prefix(key, "stale_timeout", suffix)) {
+        // Default timeout and per sensor type timeouts (stale_timeout.<sensorType>), in seconds
+        config->stale_timeouts[suffix] = std::chrono::seconds(std::stoi(value));
+      } else if (match_prefix(key, "sensor_type", suffix) && !suffix.empty()) {
+        // sensor_type.<received type>=<supported type>
+        config->sensor_types[suffix] = value;
+      } else if (match_prefix(key, "threshold", suffix) && !suffix.empty()) {
+        config->thresholds[suffix] = std::stof(value);
+      } else {
+        std::cerr << "Error parsing not defined parameter: " << key << std::endl;
+        return nullptr;
+      }
+    } catch (const std::exception &) {
+      std::cerr << "Error parsing value of parameter " << key << ": " << value << std::endl;
+      return nullptr;
+    }
+  }
+  std::cout << std::endl << " Finished configuration ...";
+  configFile.close();
+  return config;
+}
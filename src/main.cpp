@@ -14,60 +14,16 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <csignal>
 #include <iostream>
 #include <string>
-#include <map>
-#include <sstream>
-#include <fstream>
+#include "mqtt_dsr_agent/agent_config.hpp"
 #include "mqtt_dsr_agent/mqtt_agent.hpp"
 
-std::map<std::string, std::string> set_configuration(const std::string & config_file)
-{
-  // Map to be retuned
-  std::map<std::string, std::string> config_map;
-  // Open config file
-  std::ifstream configFile(config_file);
-  if (!configFile.is_open()) {
-    std::cerr << "Couldn't open config file: " << config_file << std::endl;
-    return {};
-  }
-  // Read lines from config file and parse the parameters
-  std::string line;
-  std::cout << "Configuration parameters:";
-  while (std::getline(configFile, line)) {
-    std::istringstream is_line(line);
-    std::string key, value;
-    if (std::getline(is_line, key, '=') && std::getline(is_line, value)) {
-      if (key == "agent_id") {
-        config_map["agent_id"] = value;
-      } else if (key == "agent_name") {
-        config_map["agent_name"] = value;
-      } else if (key == "robot_name") {
-        config_map["robot_name"] = value;
-      } else if (key == "server_address") {
-        config_map["server_address"] = value;
-      } else if (key == "client_id") {
-        config_map["client_id"] = value;
-      } else if (key == "topic") {
-        config_map["topic"] = value;
-      } else if (key == "parent_node") {
-        config_map["parent_node"] = value;
-      } else if (key == "sensor_name") {
-        config_map["sensor_name"] = value;
-      } else if (key == "server_username") {
-        config_map["server_username"] = value;
-      } else if (key == "server_password") {
-        config_map["server_password"] = value;
-      } else {
-        std::cerr << "Error parsing not defined parameter: " << key << std::endl;
-        return {};
-      }
-    }
-  }
-  std::cout << std::endl << " Finished configuration ...";
-  configFile.close();
-  return config_map;
-}
+// Agent notified by the signal handlers
+MqttAgent * signal_agent = nullptr;
+// Room created when no topology file is configured
+const char * DEFAULT_ROOM = "salon";
 
 int main(int argc, char * argv[])
 {
@@ -77,16 +33,35 @@ int main(int argc, char * argv[])
       " <./build/mqtt_dsr_agent path_to_this_directory/etc/config>" << std::endl;
     return -1;
   }
-  std::map<std::string, std::string> config_map = set_configuration(argv[1]);
+  auto config = load_configuration(argv[1]);
+  if (!config) {
+    return -1;
+  }
   auto mqtt_agent = std::make_shared<MqttAgent>(
-    std::stoi(config_map["agent_id"]),
-    config_map["agent_name"],
-    config_map["robot_name"],
-    config_map["topic"],
-    config_map["server_address"],
-    config_map["client_id"]);
-  // set connection credentials
-  mqtt_agent->set_credentials(config_map["server_username"],config_map["server_password"]);
+    config->agent_id,
+    config->agent_name,
+    config->robot_name,
+    config->topics.empty() ? "" : config->topics.front(),
+    config->server_address,
+    config->client_id);
+  // set credentials, topics, timeouts, statistics, tracing and publishing
+  mqtt_agent->apply_configuration(config);
+  // reload the configuration when the file changes or on SIGHUP
+  mqtt_agent->watch_configuration(argv[1]);
+  // create the rooms and sensors of the building before the first message arrives
+  if (!config->topology_file.empty()) {
+    if (!mqtt_agent->load_topology(config->topology_file)) {
+      return -1;
+    }
+  } else {
+    std::cerr << "WARNING: No topology_file configured. Only the default room ["
+              << DEFAULT_ROOM << "] is created" << std::endl;
+    mqtt_agent->add_room(DEFAULT_ROOM);
+  }
+  // SIGUSR1 dumps the traced spans and SIGHUP reloads the configuration
+  signal_agent = mqtt_agent.get();
+  std::signal(SIGUSR1, [](int) {signal_agent->request_trace_dump();});
+  std::signal(SIGHUP, [](int) {signal_agent->request_reload();});
   mqtt_agent->connect();
   return app.exec();
 }
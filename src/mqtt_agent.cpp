@@ -14,7 +14,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <iostream>
+#include <fstream>
 #include <chrono>
 
 #include "mqtt_dsr_agent/mqtt_agent.hpp"
@@ -25,7 +27,8 @@ MqttAgent::MqttAgent(
   const std::string & server_address,
   const std::string & client_id)
 : agent_id_(agent_id), agent_name_(agent_name), source_(source), topic_(topic),
-  server_address_(server_address), client_id_(client_id), client_(server_address_, client_id_)
+  server_address_(server_address), client_id_(client_id), client_(server_address_, client_id_),
+  liveness_wheel_(std::chrono::milliseconds(500))
 {
   /* ----------------------------------------  DSR  ---------------------------------------- */
   // Register types for signals
@@ -57,14 +60,39 @@ MqttAgent::MqttAgent(
   client_.set_callback(*this);
   std::cout << std::endl << " Finished client configuration ...";
 
-  // TESTS JP: Crea nodo padre
-  auto room_node = G_->get_node("salon");
-  if (!room_node.has_value()) {
-    room_node.emplace(DSR::Node::create<room_node_type>("salon"));
-    if (auto id = G_->insert_node(room_node.value()); id.has_value()) {
-      G_->update_node(room_node.value());
-    }
-  }
+  /* --------------------  LIVENESS  --------------------*/
+  QObject::connect(&stale_timer_, &QTimer::timeout, this, &MqttAgent::check_stale_sensors);
+  stale_timer_.start(static_cast<int>(liveness_wheel_.resolution().count()));
+
+  /* --------------------  STATS  --------------------*/
+  QObject::connect(&stats_timer_, &QTimer::timeout, this, &MqttAgent::report_stats);
+  steady_state_timer_.setSingleShot(true);
+  QObject::connect(
+    &steady_state_timer_, &QTimer::timeout, this, &MqttAgent::report_steady_state);
+
+  /* --------------------  SIGNAL REQUESTS  --------------------*/
+  QObject::connect(&request_timer_, &QTimer::timeout, this, [this]() {
+      if (tracer_.take_dump_request()) {
+        dump_trace();
+      }
+      if (reload_requested_.exchange(false)) {
+        reload_configuration();
+      }
+    });
+  request_timer_.start(200);
+
+  /* --------------------  CONFIGURATION  --------------------*/
+  config_ = std::make_shared<const AgentConfig>();
+  QObject::connect(
+    &config_watcher_, &QFileSystemWatcher::fileChanged, this, &MqttAgent::reload_configuration);
+
+  /* --------------------  DSR -> MQTT  --------------------*/
+  QObject::connect(&publish_timer_, &QTimer::timeout, this, &MqttAgent::publish_graph_changes);
+
+  /* --------------------  SNAPSHOT  --------------------*/
+  QObject::connect(&snapshot_timer_, &QTimer::timeout, this, &MqttAgent::publish_snapshot);
+
+  startup_time_ = std::chrono::steady_clock::now();
 }
 
 MqttAgent::~MqttAgent()
@@ -83,7 +111,7 @@ bool MqttAgent::connect()
 {
   bool connected = false;
   try {
-    mqtt::token_ptr conntok = client_.connect(conn_options_);
+    mqtt::token_ptr conntok = client_.connect(connection_options());
     conntok->wait();
     std::cout << "Connected to the MQTT broker." << std::endl;
     connected = true;
@@ -104,6 +132,423 @@ void MqttAgent::disconnect()
   }
 }
 
+void MqttAgent::apply_configuration(std::shared_ptr<const AgentConfig> config)
+{
+  if (!config) {
+    return;
+  }
+  // Swap the snapshot, the MQTT thread picks it up with the next message
+  std::shared_ptr<const AgentConfig> previous;
+  {
+    std::lock_guard<std::mutex> lock(config_mutex_);
+    previous.swap(config_);
+    config_ = config;
+  }
+
+  // Settings owned by the Qt event loop, only touched if they have changed
+  if (previous->stats_period != config->stats_period) {
+    set_stats_period(config->stats_period);
+  }
+  set_tracing(config->trace_sample_rate, config->trace_file);
+  if (previous->publish_topic != config->publish_topic ||
+    previous->publish_node_types != config->publish_node_types ||
+    previous->publish_attributes != config->publish_attributes ||
+    previous->publish_period != config->publish_period)
+  {
+    set_change_streaming(
+      config->publish_topic, config->publish_node_types, config->publish_attributes,
+      config->publish_period);
+  }
+  if (previous->snapshot_topic != config->snapshot_topic ||
+    previous->snapshot_period != config->snapshot_period)
+  {
+    set_snapshot(config->snapshot_topic, config->snapshot_period);
+  }
+  update_subscriptions(subscription_topics(*previous), subscription_topics(*config));
+}
+
+std::shared_ptr<const AgentConfig> MqttAgent::configuration() const
+{
+  std::lock_guard<std::mutex> lock(config_mutex_);
+  return config_;
+}
+
+void MqttAgent::watch_configuration(const std::string & config_file)
+{
+  config_file_ = config_file;
+  if (!config_watcher_.files().isEmpty()) {
+    config_watcher_.removePaths(config_watcher_.files());
+  }
+  config_watcher_.addPath(QString::fromStdString(config_file_));
+}
+
+void MqttAgent::reload_configuration()
+{
+  if (config_file_.empty()) {
+    return;
+  }
+  // Editors usually replace the file, which drops it from the watcher
+  if (!config_watcher_.files().contains(QString::fromStdString(config_file_))) {
+    config_watcher_.addPath(QString::fromStdString(config_file_));
+  }
+  auto config = load_configuration(config_file_);
+  if (!config) {
+    std::cerr << "Error reloading config file " << config_file_ << ". Keeping the current configuration"
+              << std::endl;
+    return;
+  }
+  auto current = configuration();
+  if (config->agent_id != current->agent_id || config->agent_name != current->agent_name ||
+    config->server_address != current->server_address || config->client_id != current->client_id)
+  {
+    std::cerr << "WARNING: agent_id, agent_name, server_address and client_id changes "
+              << "need a restart to be applied" << std::endl;
+  }
+  apply_configuration(config);
+  std::cout << "Configuration reloaded from " << config_file_ << std::endl;
+}
+
+std::vector<std::string> MqttAgent::subscription_topics(const AgentConfig & config) const
+{
+  if (config.topics.empty() && !topic_.empty()) {
+    return {topic_};
+  }
+  return config.topics;
+}
+
+std::string MqttAgent::control_topic() const
+{
+  auto topics = subscription_topics(*configuration());
+  return (topics.empty() ? std::string() : topics.front()) + "/control";
+}
+
+void MqttAgent::update_subscriptions(
+  const std::vector<std::string> & previous, const std::vector<std::string> & current)
+{
+  if (!client_.is_connected()) {
+    // The topics of the current configuration are subscribed on connection
+    return;
+  }
+  try {
+    for (const auto & topic : previous) {
+      if (std::find(current.begin(), current.end(), topic) == current.end()) {
+        client_.unsubscribe(topic);
+        std::cout << "Unsubscribed from topic " << topic << std::endl;
+      }
+    }
+    for (const auto & topic : current) {
+      if (std::find(previous.begin(), previous.end(), topic) == previous.end()) {
+        client_.subscribe(topic, QOS);
+        std::cout << "Subscribed to topic " << topic << std::endl;
+      }
+    }
+  } catch (const mqtt::exception & exc) {
+    std::cerr << "Error updating the subscriptions: " << exc.what() << std::endl;
+  }
+}
+
+void MqttAgent::set_stats_period(std::chrono::seconds period)
+{
+  stats_timer_.stop();
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    committed_messages_ = 0;
+    commit_latencies_.clear();
+    stats_start_ = std::chrono::steady_clock::now();
+    stats_enabled_ = period.count() > 0;
+  }
+  if (period.count() > 0) {
+    stats_timer_.start(static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(period).count()));
+  }
+}
+
+void MqttAgent::set_tracing(unsigned int sample_rate, const std::string & trace_file)
+{
+  trace_file_ = trace_file;
+  tracer_.set_sample_rate(sample_rate);
+}
+
+bool MqttAgent::dump_trace()
+{
+  return tracer_.dump(trace_file_);
+}
+
+bool MqttAgent::load_topology(const std::string & topology_file)
+{
+  auto start = std::chrono::steady_clock::now();
+  std::ifstream file(topology_file);
+  if (!file.is_open()) {
+    std::cerr << "Couldn't open topology file: " << topology_file << std::endl;
+    return false;
+  }
+  json topology = json::parse(file, nullptr, false);
+  if (topology.is_discarded() || !topology.is_object()) {
+    std::cerr << "Error parsing topology file: " << topology_file << std::endl;
+    return false;
+  }
+  const json rooms = topology.value("rooms", json::array());
+  const json sensors = topology.value("sensors", json::array());
+  if (!rooms.is_array() || !sensors.is_array()) {
+    std::cerr << "Error parsing topology file: 'rooms' and 'sensors' must be arrays" << std::endl;
+    return false;
+  }
+
+  // Diff against the current graph: only the missing nodes are created
+  std::size_t inserted_nodes = 0, existing_nodes = 0, inserted_edges = 0;
+  std::vector<std::pair<std::string, std::string>> in_edges;
+  auto provision = [&](const json & entry, bool is_room) {
+      if (!entry.is_object() || !entry.contains("name") || !entry["name"].is_string()) {
+        std::cerr << "WARNING: Topology entry without 'name': " << entry.dump() << std::endl;
+        return;
+      }
+      for (const auto & key : {"type", "location", "parent"}) {
+        if (entry.contains(key) && !entry[key].is_string()) {
+          std::cerr << "WARNING: Topology entry with a non string '" << key << "': "
+                    << entry.dump() << std::endl;
+          return;
+        }
+      }
+      const std::string name = entry["name"];
+      auto node = G_->get_node(name);
+      if (!node.has_value()) {
+        node.emplace(is_room ? DSR::Node::create<room_node_type>(name) :
+          DSR::Node::create<sensor_node_type>(name));
+        if (!is_room) {
+          if (entry.contains("type")) {
+            G_->add_or_modify_attrib_local<category_att>(node.value(), (std::string)(entry["type"]));
+          }
+          if (entry.contains("location")) {
+            G_->add_or_modify_attrib_local<room_att>(node.value(), (std::string)(entry["location"]));
+          }
+        }
+        if (!G_->insert_node(node.value()).has_value()) {
+          std::cerr << "ERROR: Could not insert node [" << name << "]" << std::endl;
+          return;
+        }
+        ++inserted_nodes;
+      } else {
+        ++existing_nodes;
+      }
+      if (entry.contains("parent")) {
+        in_edges.emplace_back(name, (std::string)(entry["parent"]));
+      }
+      // Provisioned sensors are expected to publish, so their liveness is tracked from now on
+      if (!is_room) {
+        std::string type = entry.value("type", "");
+        refresh_liveness(name, type);
+        update_snapshot(name, node.value());
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        unseen_sensors_.insert(name);
+      }
+    };
+  for (const auto & room : rooms) {
+    provision(room, true);
+  }
+  for (const auto & sensor : sensors) {
+    provision(sensor, false);
+  }
+
+  // Edges are inserted once every node exists, so parents can be listed after their children
+  for (const auto & [child_name, parent_name] : in_edges) {
+    auto child = G_->get_node(child_name);
+    auto parent = G_->get_node(parent_name);
+    if (!child.has_value() || !parent.has_value()) {
+      std::cerr << "ERROR: Could not find parent node [" << parent_name << "] for ["
+                << child_name << "]" << std::endl;
+      continue;
+    }
+    if (G_->get_edge(child.value().id(), parent.value().id(), "in").has_value()) {
+      continue;
+    }
+    auto edge = DSR::Edge::create<in_edge_type>(child.value().id(), parent.value().id());
+    if (G_->insert_or_assign_edge(edge)) {
+      ++inserted_edges;
+    }
+  }
+
+  std::cout << "Topology loaded from " << topology_file << ": " << inserted_nodes
+            << " nodes and " << inserted_edges << " edges inserted, " << existing_nodes
+            << " nodes already in the graph ("
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count()
+            << " ms)" << std::endl;
+  // Bound the wait for steady state, a dead or misnamed sensor would never report it
+  if (!sensors.empty()) {
+    steady_state_timer_.start(static_cast<int>(
+      std::chrono::duration_cast<std::chrono::milliseconds>(STEADY_STATE_TIMEOUT).count()));
+  }
+  return true;
+}
+
+void MqttAgent::set_change_streaming(
+  const std::string & topic, const std::set<std::string> & node_types,
+  const std::set<std::string> & attributes, std::chrono::milliseconds flush_period)
+{
+  publish_timer_.stop();
+  publish_topic_ = topic;
+  publish_node_types_ = node_types;
+  publish_attributes_ = attributes;
+  dirty_nodes_.clear();
+  published_attributes_.clear();
+  if (!publish_topic_.empty()) {
+    publish_timer_.start(static_cast<int>(std::max<std::int64_t>(flush_period.count(), 1)));
+  }
+}
+
+void MqttAgent::publish_graph_changes()
+{
+  if (dirty_nodes_.empty()) {
+    return;
+  }
+  std::set<std::uint64_t> dirty_nodes;
+  dirty_nodes.swap(dirty_nodes_);
+
+  json nodes = json::array();
+  for (const auto id : dirty_nodes) {
+    auto node = G_->get_node(id);
+    if (!node.has_value() ||
+      (!publish_node_types_.empty() && !publish_node_types_.count(node.value().type())))
+    {
+      continue;
+    }
+    // Delta against the last published values, skipping what this agent wrote itself
+    auto & published = published_attributes_[id];
+    json delta = json::object();
+    for (const auto & [name, attribute] : node.value().attrs()) {
+      if (attribute.agent_id() == static_cast<std::uint32_t>(agent_id_) ||
+        (!publish_attributes_.empty() && !publish_attributes_.count(name)))
+      {
+        continue;
+      }
+      json value = attribute_to_json(attribute);
+      if (!published.contains(name) || published[name] != value) {
+        published[name] = value;
+        delta[name] = std::move(value);
+      }
+    }
+    if (!delta.empty()) {
+      nodes.push_back({{"id", id}, {"name", node.value().name()}, {"type", node.value().type()},
+        {"attributes", std::move(delta)}});
+    }
+  }
+  if (nodes.empty()) {
+    return;
+  }
+
+  json message = {{"source", agent_name_}, {"timestamp", Tracer::now_ns()},
+    {"nodes", std::move(nodes)}};
+  std::string payload = message.dump();
+  try {
+    client_.publish(publish_topic_, payload.data(), payload.size(), QOS, false);
+  } catch (const mqtt::exception & exc) {
+    std::cerr << "Error publishing graph changes: " << exc.what() << std::endl;
+  }
+}
+
+void MqttAgent::set_snapshot(const std::string & topic, std::chrono::milliseconds period)
+{
+  snapshot_timer_.stop();
+  bool topic_changed;
+  {
+    // A period change keeps the cached state
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    topic_changed = topic != snapshot_topic_;
+    snapshot_topic_ = topic;
+    if (topic_changed) {
+      snapshot_.clear();
+      dirty_sensors_.clear();
+    }
+  }
+  if (topic.empty()) {
+    return;
+  }
+  // Start from the sensors already in the graph, so the first aggregate is complete
+  if (topic_changed) {
+    for (const auto & node : G_->get_nodes_by_type("sensor")) {
+      update_snapshot(node.name(), node);
+    }
+  }
+  snapshot_timer_.start(static_cast<int>(std::max<std::int64_t>(period.count(), 1)));
+}
+
+void MqttAgent::update_snapshot(const std::string & sensor_name, const DSR::Node & node)
+{
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    if (snapshot_topic_.empty()) {
+      return;
+    }
+  }
+  json state = {{"type", node.type()}, {"attributes", json::object()}};
+  for (const auto & [name, attribute] : node.attrs()) {
+    state["attributes"][name] = attribute_to_json(attribute);
+  }
+  // The sample timestamp changes with every reading, it does not make the state change
+  auto same_readings = [](const json & a, const json & b) {
+      if (a.is_null() || b.is_null()) {
+        return false;
+      }
+      json a_readings = a, b_readings = b;
+      a_readings["attributes"].erase("measure_timestamp");
+      b_readings["attributes"].erase("measure_timestamp");
+      return a_readings == b_readings;
+    };
+  std::lock_guard<std::mutex> lock(snapshot_mutex_);
+  auto & current = snapshot_[sensor_name];
+  if (!same_readings(current, state)) {
+    dirty_sensors_.insert(sensor_name);
+  }
+  current = std::move(state);
+}
+
+void MqttAgent::publish_snapshot()
+{
+  // Published from the snapshot timer, so each topic is updated at most once per period
+  std::vector<std::pair<std::string, std::string>> messages;
+  {
+    std::lock_guard<std::mutex> lock(snapshot_mutex_);
+    if (dirty_sensors_.empty()) {
+      return;
+    }
+    for (const auto & sensor_name : dirty_sensors_) {
+      messages.emplace_back(snapshot_topic_ + "/" + sensor_name, snapshot_[sensor_name].dump());
+    }
+    dirty_sensors_.clear();
+    messages.emplace_back(
+      snapshot_topic_, json({{"source", agent_name_}, {"timestamp", Tracer::now_ns()},
+        {"sensors", snapshot_}}).dump());
+  }
+  // Retained, so a new subscriber gets the last state of every sensor right away
+  for (const auto & [topic, payload] : messages) {
+    try {
+      client_.publish(topic, payload.data(), payload.size(), QOS, true);
+    } catch (const mqtt::exception & exc) {
+      std::cerr << "Error publishing snapshot to " << topic << ": " << exc.what() << std::endl;
+    }
+  }
+}
+
+json MqttAgent::attribute_to_json(const DSR::Attribute & attribute)
+{
+  json value;
+  std::visit([&value](const auto & v) {value = v;}, attribute.value());
+  return value;
+}
+
+bool MqttAgent::add_room(const std::string & room_name)
+{
+  auto room_node = G_->get_node(room_name);
+  if (!room_node.has_value()) {
+    room_node.emplace(DSR::Node::create<room_node_type>(room_name));
+    if (!G_->insert_node(room_node.value()).has_value()) {
+      std::cerr << "ERROR: Could not insert room node [" << room_name << "]" << std::endl;
+      return false;
+    }
+    std::cout << "Inserted room node [" << room_name << "] in the graph." << std::endl;
+  }
+  return true;
+}
+
 // void MqttAgent::set_topics(const std::vector<std::string> & topics)
 // {
 //     topics_ = topics;
@@ -111,13 +556,29 @@ void MqttAgent::disconnect()
 
 /* ----------------------------------------  DSR  -------------------- -------------------- */
 // Callbacks called when the DSR graph is changed
-void MqttAgent::node_updated(std::uint64_t /*id*/, const std::string & /*type*/)
+void MqttAgent::node_updated(std::uint64_t id, const std::string & type)
 {
+  // Only mark the node, the changes are read and published by the publish timer
+  if (!publish_topic_.empty() &&
+    (publish_node_types_.empty() || publish_node_types_.count(type)))
+  {
+    dirty_nodes_.insert(id);
+  }
 }
 
 void MqttAgent::node_attributes_updated(
-  uint64_t /*id*/, const std::vector<std::string> & /*att_names*/)
+  uint64_t id, const std::vector<std::string> & att_names)
 {
+  if (publish_topic_.empty()) {
+    return;
+  }
+  if (publish_attributes_.empty() ||
+    std::any_of(
+      att_names.begin(), att_names.end(),
+      [this](const std::string & name) {return publish_attributes_.count(name) > 0;}))
+  {
+    dirty_nodes_.insert(id);
+  }
 }
 
 void MqttAgent::edge_updated(
@@ -146,9 +607,9 @@ void MqttAgent::edge_updated(
           person_node_ = from_node;
           // send control msg to sensor
           const char * payload = "OnSensor";
-          std::string control_topic = topic_ + "/control";
-          std::cout << "Control Topic: " << control_topic << std::endl;
-          client_.publish(control_topic, payload, strlen(payload), QOS, false);
+          std::string topic = control_topic();
+          std::cout << "Control Topic: " << topic << std::endl;
+          client_.publish(topic, payload, strlen(payload), QOS, false);
           std::cout << "Person: " << person_node_.value().name() << std::endl;
           std::cout << "FMCW Sensor measurement has started...:" << std::endl;
         }
@@ -164,8 +625,10 @@ void MqttAgent::edge_attributes_updated(
 {
 }
 
-void MqttAgent::node_deleted(std::uint64_t /*id*/)
+void MqttAgent::node_deleted(std::uint64_t id)
 {
+  dirty_nodes_.erase(id);
+  published_attributes_.erase(id);
 }
 
 void MqttAgent::edge_deleted(std::uint64_t from, std::uint64_t to, const std::string & edge_tag)
@@ -180,7 +643,6 @@ void MqttAgent::edge_deleted(std::uint64_t from, std::uint64_t to, const std::st
         std::cout << "Delete person in bed" << std::endl;
         person_node_ = {};
         const char * payload = "OffSensor";
-        std::string control_topic = topic_ + "/control";
         client_.publish("Sensor/Control", payload, strlen(payload), QOS, false);
         control_ = false;
         std::cout << "Person has left the room, stop measuring ..." << std::endl;
@@ -195,30 +657,36 @@ void MqttAgent::edge_deleted(std::uint64_t from, std::uint64_t to, const std::st
 }
 // ----------------------------------------------------------------------------------------------
 
-int MqttAgent::sensor_data_to_dsr(json data)
+int MqttAgent::sensor_data_to_dsr(const json & data, SensorBatch & batch)
 {
+  TraceSpan span(tracer_, "sensor_data_to_dsr");
+  std::optional<TraceSpan> stage;
   // check all relevant message metadata are available
   if ( (!data.contains("sensorName")) || (!data.contains("sensorType")) || (!data.contains("sensorLocation")) || (!data.contains("parentNode"))) {
     std::cout << "sensor_data_to_dsr ERROR: Received message has not adequate metadata. No action performed" << std::endl;
     return 0;
   }
 
-  string sensor_name_ = data["sensorName"];
-  string parent_node_name_ = data["parentNode"];
+  // Snapshot of the configuration used for the whole reading
+  auto config = configuration();
+  string sensor_name_ = data.at("sensorName");
+  string sensor_type_ = config->sensor_type((std::string)(data.at("sensorType")));
+  string parent_node_name_ = data.at("parentNode");
 
   // get or create timestamp  
   long long int timestamp_;
   if ( data.contains("timestamp") )
-    timestamp_ = data["timestamp"]; // timestamp provided
+    timestamp_ = data.at("timestamp"); // timestamp provided
   else {
     // timestamp assigned upon reception
     std::cout << "WARNING: Received message had no timestamp. Assigning reception time as node timestamp" << std::endl;
     auto now = std::chrono::system_clock::now();
-    timestamp_ = static_cast<int>(std::chrono::duration_cast<
+    timestamp_ = static_cast<long long int>(std::chrono::duration_cast<
         std::chrono::nanoseconds>(now.time_since_epoch()).count());
   }
 
   // Check if parent node exists (if not, we cannot put the sensor in the world!)
+  stage.emplace(tracer_, "node_lookup");
   auto parent_node_ = G_->get_node(parent_node_name_);
   if (!parent_node_.has_value()) {
     std::cout << "ERROR: Could not find parent node [" << parent_node_name_ << "] for sensor [" << sensor_name_ << "]. "
@@ -226,8 +694,14 @@ int MqttAgent::sensor_data_to_dsr(json data)
     return 0;
   }
 
-  // Then check if sensor node has been created and create it if necessary 
-  auto sensor_node = G_->get_node(sensor_name_);
+  // Then check if sensor node has been created and create it if necessary.
+  // A sensor already staged in this batch keeps accumulating on the staged copy
+  std::optional<DSR::Node> sensor_node;
+  if (auto staged = batch.find(sensor_name_); staged != batch.end()) {
+    sensor_node = staged->second.node;
+  } else {
+    sensor_node = G_->get_node(sensor_name_);
+  }
   // if there's no node of that type, create node
   if (!sensor_node.has_value()) {
     sensor_node.emplace(DSR::Node::create<sensor_node_type>(sensor_name_));
@@ -243,34 +717,34 @@ int MqttAgent::sensor_data_to_dsr(json data)
     }
   }
  
+  stage.emplace(tracer_, "attribute_writes");
   // insert category attribute
-  G_->add_or_modify_attrib_local<category_att>(sensor_node.value(), (std::string)(data["sensorType"]));
+  G_->add_or_modify_attrib_local<category_att>(sensor_node.value(), sensor_type_);
+  // the sensor is alive again (if it was offline) as soon as it publishes
+  G_->add_or_modify_attrib_local<sensor_offline_att>(sensor_node.value(), false);
 
   // Check type of msg and update the sensor node with the new data
-  if (data["sensorType"] == "calidad_aire"){ 
+  if (sensor_type_ == "calidad_aire"){ 
     // Add location (we use a 'room' attribute for this)
-    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data["sensorLocation"]));
-    // Parse air quality values, update the sensor node and insert it
-    G_->add_or_modify_attrib_local<pm1_att>(sensor_node.value(), (int)(data["pm1.0 (ug/m3)"]));
-    G_->add_or_modify_attrib_local<pm25_att>(sensor_node.value(), (int)(data["pm2.5 (ug/m3)"]));
-    G_->add_or_modify_attrib_local<pm10_att>(sensor_node.value(), (int)(data["pm10 (ug/m3)"]));
-    G_->add_or_modify_attrib_local<co2_att>(sensor_node.value(), (int)(data["CO2 (ppm)"]));
-    G_->add_or_modify_attrib_local<tvoc_att>(sensor_node.value(), (int)(data["TVOC (lvl)"]));
-    G_->add_or_modify_attrib_local<ch2o_att>(sensor_node.value(), (int)(data["CH2O (ug/m3)"]));
-    G_->add_or_modify_attrib_local<co_att>(sensor_node.value(), (float)(data["CO (ppm)"]));
-    G_->add_or_modify_attrib_local<o3_att>(sensor_node.value(), (int)(data["O3 (ppb)"]));
-    G_->add_or_modify_attrib_local<no2_att>(sensor_node.value(), (int)(data["NO2 (ppb)"]));
-    G_->add_or_modify_attrib_local<temperature_att>(sensor_node.value(), (float)(data["temp (celsius)"]));
-    G_->add_or_modify_attrib_local<humidity_att>(sensor_node.value(), (float)(data["humidity (percent)"]));
-    if (data.contains("toInfluxDB"))
-      G_->add_or_modify_attrib_local<toinflux_att>(sensor_node.value(), (bool)(data["toInfluxDB"]));
-    G_->add_or_modify_attrib_local<measure_timestamp_att>(sensor_node.value(), (uint64_t)(timestamp_));
-    G_->update_node(sensor_node.value());
-    std::cout << "Sensor node [" << sensor_name_ << "] has been updated." << std::endl;
+    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data.at("sensorLocation")));
+    // Parse air quality values
+    G_->add_or_modify_attrib_local<pm1_att>(sensor_node.value(), (int)(data.at("pm1.0 (ug/m3)")));
+    G_->add_or_modify_attrib_local<pm25_att>(sensor_node.value(), (int)(data.at("pm2.5 (ug/m3)")));
+    G_->add_or_modify_attrib_local<pm10_att>(sensor_node.value(), (int)(data.at("pm10 (ug/m3)")));
+    G_->add_or_modify_attrib_local<co2_att>(sensor_node.value(), (int)(data.at("CO2 (ppm)")));
+    G_->add_or_modify_attrib_local<tvoc_att>(sensor_node.value(), (int)(data.at("TVOC (lvl)")));
+    G_->add_or_modify_attrib_local<ch2o_att>(sensor_node.value(), (int)(data.at("CH2O (ug/m3)")));
+    G_->add_or_modify_attrib_local<co_att>(sensor_node.value(), (float)(data.at("CO (ppm)")));
+    G_->add_or_modify_attrib_local<o3_att>(sensor_node.value(), (int)(data.at("O3 (ppb)")));
+    G_->add_or_modify_attrib_local<no2_att>(sensor_node.value(), (int)(data.at("NO2 (ppb)")));
+    G_->add_or_modify_attrib_local<temperature_att>(sensor_node.value(), (float)(data.at("temp (celsius)")));
+    G_->add_or_modify_attrib_local<humidity_att>(sensor_node.value(), (float)(data.at("humidity (percent)")));
   }  
-  else if (data["sensorType"] == "datoRadarRespiracion") {
+  else if (sensor_type_ == "datoRadarRespiracion") {
     // First check data is valid
-    if (data["heartrate"] <= 30 || data["breathrate"] <= 10) {
+    if (data.at("heartrate") <= config->threshold("heartrate_min", 30) ||
+      data.at("breathrate") <= config->threshold("breathrate_min", 10))
+    {
       return 0;
     }  
     // Set "MEASURING" edge between sensor and person once for RespiratoryHeartbeatSensor
@@ -286,63 +760,227 @@ int MqttAgent::sensor_data_to_dsr(json data)
         }
       }
     }
-    // Parse vital parameters, update the sensor node and insert it
-    G_->add_or_modify_attrib_local<heartrate_att>(sensor_node.value(), (float)(data["heartrate"]));
-    G_->add_or_modify_attrib_local<breathrate_att>(sensor_node.value(), (float)(data["breathrate"]));
-    if (data.contains("toInfluxDB"))
-      G_->add_or_modify_attrib_local<toinflux_att>(sensor_node.value(), (bool)(data["toInfluxDB"]));
-    G_->add_or_modify_attrib_local<measure_timestamp_att>(sensor_node.value(), (uint64_t)(timestamp_));
-    G_->update_node(sensor_node.value());
-    std::cout << "Sensor node [" << sensor_name_ << "] has been updated." << std::endl;
-  }
-  else if (data["sensorType"] == "PIR"){ 
+    // Parse vital parameters
+    G_->add_or_modify_attrib_local<heartrate_att>(sensor_node.value(), (float)(data.at("heartrate")));
+    G_->add_or_modify_attrib_local<breathrate_att>(sensor_node.value(), (float)(data.at("breathrate")));
+  }
+  else if (sensor_type_ == "PIR"){ 
     // Add location (we use a 'room' attribute for this)
-    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data["sensorLocation"]));
-    // Parse presence value, update the sensor node and insert it
-    G_->add_or_modify_attrib_local<presence_att>(sensor_node.value(), (bool)(data["presence"]));
-    if (data.contains("toInfluxDB"))
-      G_->add_or_modify_attrib_local<toinflux_att>(sensor_node.value(), (bool)(data["toInfluxDB"]));
-    G_->add_or_modify_attrib_local<measure_timestamp_att>(sensor_node.value(), (uint64_t)(timestamp_));
-    G_->update_node(sensor_node.value());
-    std::cout << "Sensor node [" << sensor_name_ << "] has been updated." << std::endl;
+    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data.at("sensorLocation")));
+    // Parse presence value
+    G_->add_or_modify_attrib_local<presence_att>(sensor_node.value(), (bool)(data.at("presence")));
   } 
-  else if (data["sensorType"] == "Contact"){ 
+  else if (sensor_type_ == "Contact"){ 
     // Add location (we use a 'room' attribute for this)
-    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data["sensorLocation"]));
-    // Parse open value, update the sensor node and insert it
-    G_->add_or_modify_attrib_local<open_att>(sensor_node.value(), (bool)(data["open"]));
-    if (data.contains("toInfluxDB"))
-      G_->add_or_modify_attrib_local<toinflux_att>(sensor_node.value(), (bool)(data["toInfluxDB"]));
-    G_->add_or_modify_attrib_local<measure_timestamp_att>(sensor_node.value(), (uint64_t)(timestamp_));
-    G_->update_node(sensor_node.value());
-    std::cout << "Sensor node [" << sensor_name_ << "] has been updated." << std::endl;
+    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data.at("sensorLocation")));
+    // Parse open value
+    G_->add_or_modify_attrib_local<open_att>(sensor_node.value(), (bool)(data.at("open")));
   } 
-  else if (data["sensorType"] == "Sound"){ 
+  else if (sensor_type_ == "Sound"){ 
     // Add location (we use a 'room' attribute for this)
-    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data["sensorLocation"]));
-    // Parse volume value, update the sensor node and insert it
-    G_->add_or_modify_attrib_local<volume_att>(sensor_node.value(), (float)(data["volume"]));
-    if (data.contains("toInfluxDB"))
-      G_->add_or_modify_attrib_local<toinflux_att>(sensor_node.value(), (bool)(data["toInfluxDB"]));
-    G_->add_or_modify_attrib_local<measure_timestamp_att>(sensor_node.value(), (uint64_t)(timestamp_));
-    G_->update_node(sensor_node.value());
-    std::cout << "Sensor node [" << sensor_name_ << "] has been updated." << std::endl;
+    G_->add_or_modify_attrib_local<room_att>(sensor_node.value(), (std::string)(data.at("sensorLocation")));
+    // Parse volume value
+    G_->add_or_modify_attrib_local<volume_att>(sensor_node.value(), (float)(data.at("volume")));
   } 
   else {
-    std::cout << "sensor_data_to_dsr ERROR: Sensor " << data["sensorType"] << " not supported by mqtt_agent (yet)" << std::endl;
+    std::cout << "sensor_data_to_dsr ERROR: Sensor " << data.at("sensorType") << " not supported by mqtt_agent (yet)" << std::endl;
     return 0;
   }
 
+  if (data.contains("toInfluxDB"))
+    G_->add_or_modify_attrib_local<toinflux_att>(sensor_node.value(), (bool)(data.at("toInfluxDB")));
+  G_->add_or_modify_attrib_local<measure_timestamp_att>(sensor_node.value(), (uint64_t)(timestamp_));
+
+  // Stage the node, it is inserted in the graph when the batch is committed
+  batch.insert_or_assign(sensor_name_, PendingSensorUpdate{sensor_node.value(), sensor_type_,
+    data.contains("timestamp") ? std::optional<long long int>(timestamp_) : std::nullopt});
   return 1;
 }
 
+void MqttAgent::commit_sensor_batch(SensorBatch & batch)
+{
+  TraceSpan span(tracer_, "commit_sensor_batch");
+  for (auto & [sensor_name, update] : batch) {
+    bool updated;
+    {
+      // Committed and rearmed together, so check_stale_sensors never marks a fresh reading offline
+      std::lock_guard<std::mutex> lock(sensor_commit_mutex_);
+      TraceSpan update_span(tracer_, "update_node");
+      updated = G_->update_node(update.node);
+      if (updated) {
+        refresh_liveness(sensor_name, update.type);
+      }
+    }
+    if (updated) {
+      std::cout << "Sensor node [" << sensor_name << "] has been updated." << std::endl;
+      update_snapshot(sensor_name, update.node);
+      record_commit(sensor_name, update.timestamp);
+    }
+  }
+  batch.clear();
+}
+
+void MqttAgent::record_commit_latency(long long int timestamp)
+{
+  auto now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  if (stats_enabled_) {
+    commit_latencies_.push_back(now - timestamp);
+  }
+}
+
+void MqttAgent::record_commit(
+  const std::string & sensor_name, const std::optional<long long int> & timestamp)
+{
+  // Readings timestamped on reception say nothing about the pipeline latency
+  if (timestamp.has_value()) {
+    record_commit_latency(timestamp.value());
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  // Throughput counts every commit, with or without timestamp
+  if (stats_enabled_) {
+    ++committed_messages_;
+  }
+  // Steady state is reached when every provisioned sensor has been updated once
+  if (!unseen_sensors_.empty() && unseen_sensors_.erase(sensor_name) && unseen_sensors_.empty()) {
+    std::cout << "Steady state reached "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - startup_time_).count()
+              << " s after startup. Messages dropped until then: " << dropped_messages_ << std::endl;
+  }
+}
+
+void MqttAgent::record_drop()
+{
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  ++dropped_messages_;
+}
+
+void MqttAgent::report_stats()
+{
+  std::vector<long long int> latencies;
+  std::size_t committed = 0, unseen = 0, dropped = 0;
+  double elapsed;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    std::swap(committed, committed_messages_);
+    latencies.swap(commit_latencies_);
+    unseen = unseen_sensors_.size();
+    dropped = dropped_messages_;
+    auto now = std::chrono::steady_clock::now();
+    elapsed = std::chrono::duration<double>(now - stats_start_).count();
+    stats_start_ = now;
+  }
+  if (unseen > 0) {
+    std::cout << "Stats: steady state not reached, " << unseen
+              << " provisioned sensors not seen yet, " << dropped
+              << " messages dropped since startup" << std::endl;
+  }
+  if (committed == 0) {
+    std::cout << "Stats: no messages committed in the last " << elapsed << " s" << std::endl;
+    return;
+  }
+  if (latencies.empty()) {
+    std::cout << "Stats: " << committed / elapsed << " msg/s committed"
+              << ", no timestamped readings to measure the latency" << std::endl;
+    return;
+  }
+  auto percentile = [&latencies](double p) {
+      auto nth = latencies.begin() + static_cast<std::ptrdiff_t>(p * (latencies.size() - 1));
+      std::nth_element(latencies.begin(), nth, latencies.end());
+      return *nth / 1e6;
+    };
+  std::cout << "Stats: " << committed / elapsed << " msg/s committed"
+            << ", latency p50 " << percentile(0.50) << " ms"
+            << ", p99 " << percentile(0.99) << " ms" << std::endl;
+}
+
+void MqttAgent::report_steady_state()
+{
+  std::lock_guard<std::mutex> lock(stats_mutex_);
+  if (unseen_sensors_.empty()) {
+    return;
+  }
+  std::cout << "WARNING: Steady state not reached "
+            << std::chrono::duration<double>(std::chrono::steady_clock::now() - startup_time_).count()
+            << " s after startup. Provisioned sensors not seen yet (" << unseen_sensors_.size()
+            << "):";
+  for (const auto & sensor_name : unseen_sensors_) {
+    std::cout << " [" << sensor_name << "]";
+  }
+  std::cout << ". Messages dropped until now: " << dropped_messages_ << std::endl;
+}
+
+void MqttAgent::refresh_liveness(const std::string & sensor_name, const std::string & sensor_type)
+{
+  auto timeout = configuration()->stale_timeout(sensor_type);
+  std::lock_guard<std::mutex> lock(liveness_mutex_);
+  if (timeout.count() <= 0) {
+    liveness_wheel_.cancel(sensor_name);
+    return;
+  }
+  liveness_wheel_.schedule(sensor_name, timeout);
+}
+
+void MqttAgent::check_stale_sensors()
+{
+  std::vector<std::string> expired;
+  {
+    std::lock_guard<std::mutex> lock(liveness_mutex_);
+    expired = liveness_wheel_.advance(std::chrono::steady_clock::now());
+  }
+
+  for (const auto & sensor_name : expired) {
+    std::optional<DSR::Node> sensor_node;
+    {
+      // No reading can be committed between the check, the read and the update
+      std::lock_guard<std::mutex> commit_lock(sensor_commit_mutex_);
+      {
+        // A reading may have been committed after the deadline expired
+        std::lock_guard<std::mutex> lock(liveness_mutex_);
+        if (liveness_wheel_.contains(sensor_name)) {
+          continue;
+        }
+      }
+      sensor_node = G_->get_node(sensor_name);
+      if (!sensor_node.has_value()) {
+        continue;
+      }
+      G_->add_or_modify_attrib_local<sensor_offline_att>(sensor_node.value(), true);
+      G_->update_node(sensor_node.value());
+    }
+    std::cout << "WARNING: Sensor [" << sensor_name << "] stopped publishing. Marked as offline"
+              << std::endl;
+    update_snapshot(sensor_name, sensor_node.value());
+    // Stop claiming a measurement nobody is taking
+    for (const auto & edge : G_->get_node_edges_by_type(sensor_node.value(), "measuring")) {
+      if (G_->delete_edge(edge.from(), edge.to(), "measuring")) {
+        std::cout << "Deleted edge measuring from stale sensor [" << sensor_name << "]"
+                  << std::endl;
+      }
+    }
+  }
+}
+
 /* ----------------------------------------  MQTT -------------------- -------------------- */
 
+mqtt::connect_options MqttAgent::connection_options() const
+{
+  // Credentials come from the configuration snapshot, so a reload never touches shared options
+  mqtt::connect_options options = conn_options_;
+  auto config = configuration();
+  if (!config->server_username.empty()) {
+    options.set_user_name(config->server_username);
+    options.set_password(config->server_password);
+  }
+  return options;
+}
+
 void MqttAgent::reconnect(int delay)
 {
   std::this_thread::sleep_for(std::chrono::milliseconds(delay));
   try {
-    client_.connect(conn_options_, nullptr, *this);
+    client_.connect(connection_options(), nullptr, *this);
   } catch (const mqtt::exception & exc) {
     std::cerr << "Error: " << exc.what() << std::endl;
     exit(1);
@@ -379,7 +1017,10 @@ void MqttAgent::connected(const std::string & cause)
   std::cout << "Connection success" << std::endl;
   std::cout << "Subscribing to topics ";
 
-  client_.subscribe(topic_, QOS);
+  for (const auto & topic : subscription_topics(*configuration())) {
+    std::cout << topic << " ";
+    client_.subscribe(topic, QOS);
+  }
 
   std::cout << std::endl;
 }
@@ -398,17 +1039,64 @@ void MqttAgent::connection_lost(const std::string & cause)
 
 void MqttAgent::message_arrived(mqtt::const_message_ptr msg)
 {
-  string j_object_str = msg->get_payload_str();
-  json j_object = json::parse(j_object_str);
+  const bool traced = tracer_.begin_sample();
+  const std::int64_t arrival_ns = traced ? Tracer::now_ns() : 0;
+  TraceSpan span(tracer_, "message_arrived");
 
-  // check message type
-  if ( (!j_object.contains("sensorType")) || (!j_object.contains("sensorName")) ) {
-    std::cout << " WARNING: No 'sensorType' or 'sensorName' key found in the message. No action performed" << std::endl;
-    return; 
+  json j_object;
+  {
+    TraceSpan parse_span(tracer_, "json_parse");
+    j_object = json::parse(msg->get_payload_str(), nullptr, false);
   }
-  else {
-    std::cout << "Message received from sensor " << j_object["sensorName"] << ". Type: " << j_object["sensorType"] << std::endl;
+  if (j_object.is_discarded()) {
+    std::cout << " WARNING: Received message is not a valid JSON. No action performed" << std::endl;
+    return;
+  }
+
+  // Gateways aggregate many readings in one message: either a plain array of readings or an
+  // object with a 'readings' array whose other keys are shared by all the readings
+  json readings;
+  if (j_object.is_array()) {
+    readings = std::move(j_object);
+  } else if (j_object.contains("readings") && j_object["readings"].is_array()) {
+    readings = std::move(j_object["readings"]);
+    j_object.erase("readings");
+    for (auto & reading : readings) {
+      if (reading.is_object()) {
+        for (auto it = j_object.begin(); it != j_object.end(); ++it) {
+          reading.emplace(it.key(), it.value());
+        }
+      }
+    }
+  } else {
+    readings = json::array({std::move(j_object)});
+  }
+
+  SensorBatch batch;
+  for (const auto & reading : readings) {
+    // check message type
+    if (!reading.is_object() || (!reading.contains("sensorType")) || (!reading.contains("sensorName")) ) {
+      std::cout << " WARNING: No 'sensorType' or 'sensorName' key found in the message. No action performed" << std::endl;
+      continue;
+    }
+    else {
+      std::cout << "Message received from sensor " << reading.at("sensorName") << ". Type: " << reading.at("sensorType") << std::endl;
+    }
+    // Time from the sensor sample to the Paho callback (includes the broker and the network)
+    if (traced && reading.contains("timestamp") && reading.at("timestamp").is_number_integer()) {
+      tracer_.record("delivery", reading.at("timestamp").get<std::int64_t>(), arrival_ns);
+    }
+    // A reading with missing or badly typed fields is dropped without affecting the rest
+    int uploaded = 0;
+    try {
+      uploaded = sensor_data_to_dsr(reading, batch);
+    } catch (const json::exception & exc) {
+      std::cout << " WARNING: Invalid data message from sensor " << reading.at("sensorName") << ": " << exc.what() << std::endl;
+    }
+    if (!uploaded) {
+      std::cout << " WARNING: Data message from sensor " << reading.at("sensorName") << " not uploaded in the DSR" << std::endl;
+      record_drop();
+    }
   }
-  if (!sensor_data_to_dsr(j_object))
-    std::cout << " WARNING: Data message from sensor " << j_object["sensorName"] << " not uploaded in the DSR" << std::endl;
+  commit_sensor_batch(batch);
 }
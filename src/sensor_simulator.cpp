@@ -0,0 +1,203 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Synthetic sensor fleet publishing realistic payloads to the MQTT broker. It is used to find
+// the saturation point of the agent: the simulator reports the sustained delivery rate and the
+// agent (stats_period in its config) reports the throughput and latency it actually achieves.
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mqtt/async_client.h"
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+const std::vector<std::string> SENSOR_TYPES = {
+  "calidad_aire", "datoRadarRespiracion", "PIR", "Contact", "Sound"};
+
+std::map<std::string, std::string> parse_arguments(int argc, char * argv[])
+{
+  // Default values
+  std::map<std::string, std::string> args = {
+    {"server_address", "mqtt://localhost:1883"},
+    {"client_id", "mqtt_sensor_simulator"},
+    {"server_username", ""},
+    {"server_password", ""},
+    {"topic", "avispa/smarthome"},
+    {"parent_node", "salon"},
+    {"sensors", "10"},
+    {"rate", "1.0"},
+    {"burst", "1"},
+    {"duration", "60"},
+    {"qos", "0"}
+  };
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    auto pos = arg.find('=');
+    if (pos == std::string::npos || !args.count(arg.substr(0, pos))) {
+      std::cerr << "Error parsing not defined parameter: " << arg << std::endl;
+      return {};
+    }
+    args[arg.substr(0, pos)] = arg.substr(pos + 1);
+  }
+  return args;
+}
+
+json make_payload(
+  const std::string & type, const std::string & name, const std::string & parent_node,
+  std::mt19937 & rng)
+{
+  std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+  json j;
+  j["sensorName"] = name;
+  j["sensorType"] = type;
+  j["sensorLocation"] = parent_node;
+  j["parentNode"] = parent_node;
+  j["toInfluxDB"] = false;
+  if (type == "calidad_aire") {
+    j["pm1.0 (ug/m3)"] = static_cast<int>(2 + 10 * unit(rng));
+    j["pm2.5 (ug/m3)"] = static_cast<int>(5 + 20 * unit(rng));
+    j["pm10 (ug/m3)"] = static_cast<int>(10 + 30 * unit(rng));
+    j["CO2 (ppm)"] = static_cast<int>(400 + 800 * unit(rng));
+    j["TVOC (lvl)"] = static_cast<int>(4 * unit(rng));
+    j["CH2O (ug/m3)"] = static_cast<int>(5 + 20 * unit(rng));
+    j["CO (ppm)"] = 0.1f + 2.0f * unit(rng);
+    j["O3 (ppb)"] = static_cast<int>(10 + 40 * unit(rng));
+    j["NO2 (ppb)"] = static_cast<int>(5 + 30 * unit(rng));
+    j["temp (celsius)"] = 18.0f + 8.0f * unit(rng);
+    j["humidity (percent)"] = 30.0f + 40.0f * unit(rng);
+  } else if (type == "datoRadarRespiracion") {
+    j["heartrate"] = 55.0f + 40.0f * unit(rng);
+    j["breathrate"] = 12.0f + 8.0f * unit(rng);
+  } else if (type == "PIR") {
+    j["presence"] = unit(rng) < 0.3f;
+  } else if (type == "Contact") {
+    j["open"] = unit(rng) < 0.5f;
+  } else if (type == "Sound") {
+    j["volume"] = 30.0f + 50.0f * unit(rng);
+  }
+  // Timestamp (EPOCH time in nanoseconds) taken right before publishing
+  j["timestamp"] = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+  return j;
+}
+
+int main(int argc, char * argv[])
+{
+  auto args = parse_arguments(argc, argv);
+  if (args.empty()) {
+    std::cerr << "Error calling the executable, try:" <<
+      " <./build/mqtt_sensor_simulator server_address=mqtt://localhost:1883 sensors=10"
+      " rate=1.0 burst=1 duration=60 qos=0>" << std::endl;
+    return -1;
+  }
+  const int sensors = std::stoi(args["sensors"]);
+  const double rate = std::stod(args["rate"]);
+  const int burst = std::stoi(args["burst"]);
+  const int qos = std::stoi(args["qos"]);
+  const auto duration = std::chrono::seconds(std::stoi(args["duration"]));
+  if (sensors <= 0 || rate <= 0.0 || burst <= 0) {
+    std::cerr << "Error: sensors, rate and burst must be positive" << std::endl;
+    return -1;
+  }
+
+  mqtt::async_client client(args["server_address"], args["client_id"]);
+  mqtt::connect_options conn_options;
+  conn_options.set_clean_session(true);
+  if (!args["server_username"].empty()) {
+    conn_options.set_user_name(args["server_username"]);
+    conn_options.set_password(args["server_password"]);
+  }
+  try {
+    client.connect(conn_options)->wait();
+  } catch (const mqtt::exception & exc) {
+    std::cerr << "Error connecting to the MQTT broker: " << exc.what() << std::endl;
+    return -1;
+  }
+
+  std::cout << "Simulating " << sensors << " sensors of each type at " << rate
+            << " Hz (bursts of " << burst << ") for " << duration.count() << " s" << std::endl;
+
+  // Every round, each sensor publishes a burst of readings
+  std::mt19937 rng(std::random_device{}());
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(1.0 / rate));
+  const auto start = std::chrono::steady_clock::now();
+  auto next_round = start;
+  auto last_report = start;
+  std::size_t published = 0, failed = 0, published_since_report = 0;
+  std::vector<mqtt::delivery_token_ptr> tokens;
+  while (std::chrono::steady_clock::now() - start < duration) {
+    tokens.clear();
+    for (const auto & type : SENSOR_TYPES) {
+      for (int i = 0; i < sensors; ++i) {
+        const std::string name = "sim_" + type + "_" + std::to_string(i);
+        for (int b = 0; b < burst; ++b) {
+          std::string payload = make_payload(type, name, args["parent_node"], rng).dump();
+          try {
+            tokens.push_back(
+              client.publish(args["topic"], payload.data(), payload.size(), qos, false));
+          } catch (const mqtt::exception &) {
+            ++failed;
+          }
+        }
+      }
+    }
+    // Only the messages actually handed to the broker count, not the queued ones
+    for (const auto & token : tokens) {
+      try {
+        token->wait();
+        ++published;
+        ++published_since_report;
+      } catch (const mqtt::exception &) {
+        ++failed;
+      }
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_report >= std::chrono::seconds(1)) {
+      std::cout << "Delivered " << published_since_report /
+        std::chrono::duration<double>(now - last_report).count() << " msg/s" << std::endl;
+      last_report = now;
+      published_since_report = 0;
+    }
+    next_round += period;
+    if (next_round > now) {
+      std::this_thread::sleep_until(next_round);
+    } else {
+      // The simulator cannot keep the requested rate, do not try to catch up
+      next_round = now;
+    }
+  }
+
+  const double elapsed = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+  std::cout << "Delivered " << published << " messages (" << failed << " failed) in "
+            << elapsed << " s: " << published / elapsed << " msg/s sustained" << std::endl;
+
+  try {
+    client.disconnect()->wait();
+  } catch (const mqtt::exception & exc) {
+    std::cerr << "Error disconnecting from the MQTT broker: " << exc.what() << std::endl;
+  }
+  return 0;
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+
+#include "mqtt_dsr_agent/timing_wheel.hpp"
+
+TimingWheel::TimingWheel(std::chrono::milliseconds resolution)
+: resolution_(std::max(resolution, std::chrono::milliseconds(1))),
+  start_(std::chrono::steady_clock::now()), current_tick_(0)
+{
+}
+
+void TimingWheel::schedule(const std::string & key, std::chrono::milliseconds timeout)
+{
+  cancel(key);
+  // Round up to whole ticks, a deadline never expires in the current tick
+  std::uint64_t ticks = (std::max<std::int64_t>(timeout.count(), 0) + resolution_.count() - 1) /
+    resolution_.count();
+  ticks = std::clamp<std::uint64_t>(ticks, 1, MAX_TICKS);
+  insert({key, current_tick_ + ticks});
+}
+
+bool TimingWheel::cancel(const std::string & key)
+{
+  auto location = index_.find(key);
+  if (location == index_.end()) {
+    return false;
+  }
+  wheels_[location->second.level][location->second.slot].erase(location->second.it);
+  index_.erase(location);
+  return true;
+}
+
+bool TimingWheel::contains(const std::string & key) const
+{
+  return index_.find(key) != index_.end();
+}
+
+std::vector<std::string> TimingWheel::advance(std::chrono::steady_clock::time_point now)
+{
+  std::vector<std::string> expired;
+  if (now <= start_) {
+    return expired;
+  }
+  const std::uint64_t target_tick = std::chrono::duration_cast<std::chrono::milliseconds>(
+    now - start_).count() / resolution_.count();
+  while (current_tick_ < target_tick) {
+    ++current_tick_;
+    // Cascade the upper levels whose lower bits have just wrapped around
+    for (std::size_t level = LEVELS - 1; level > 0; --level) {
+      const std::uint64_t mask = (1ULL << (SLOT_BITS * level)) - 1;
+      if ((current_tick_ & mask) == 0) {
+        cascade(level, (current_tick_ >> (SLOT_BITS * level)) & (SLOTS - 1));
+      }
+    }
+    // Every entry in the current slot of the lowest level expires now
+    auto & slot = wheels_[0][current_tick_ & (SLOTS - 1)];
+    for (auto & entry : slot) {
+      index_.erase(entry.key);
+      expired.push_back(std::move(entry.key));
+    }
+    slot.clear();
+  }
+  return expired;
+}
+
+void TimingWheel::insert(Entry entry)
+{
+  const std::uint64_t delta = entry.expiry - current_tick_;
+  std::size_t level = 0;
+  while (level < LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * (level + 1)))) {
+    ++level;
+  }
+  const std::size_t slot = (entry.expiry >> (SLOT_BITS * level)) & (SLOTS - 1);
+  auto & list = wheels_[level][slot];
+  const std::string key = entry.key;
+  auto it = list.insert(list.end(), std::move(entry));
+  index_[key] = {level, slot, it};
+}
+
+void TimingWheel::cascade(std::size_t level, std::size_t slot)
+{
+  Slot entries;
+  entries.swap(wheels_[level][slot]);
+  for (auto & entry : entries) {
+    insert(std::move(entry));
+  }
+}
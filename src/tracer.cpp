@@ -0,0 +1,113 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "mqtt_dsr_agent/tracer.hpp"
+
+namespace
+{
+// Sampling decision and buffer of the calling thread
+thread_local bool thread_sampled = false;
+thread_local const void * thread_owner = nullptr;
+thread_local std::shared_ptr<void> thread_buffer_ptr;
+}  // namespace
+
+Tracer::Tracer(std::size_t capacity)
+: capacity_(std::max<std::size_t>(capacity, 1)), sample_rate_(0), sample_counter_(0),
+  dump_requested_(false)
+{
+}
+
+bool Tracer::begin_sample()
+{
+  const unsigned int rate = sample_rate_;
+  thread_sampled = rate > 0 && sample_counter_++ % rate == 0;
+  return thread_sampled;
+}
+
+bool Tracer::sampling() const
+{
+  return thread_sampled;
+}
+
+void Tracer::record(const char * name, std::int64_t start_ns, std::int64_t end_ns)
+{
+  auto & buffer = thread_buffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.events[buffer.next] = {name, start_ns, end_ns - start_ns};
+  if (++buffer.next == buffer.events.size()) {
+    buffer.next = 0;
+    buffer.wrapped = true;
+  }
+}
+
+bool Tracer::dump(const std::string & path)
+{
+  std::ofstream file(path);
+  if (!file.is_open()) {
+    std::cerr << "Couldn't open trace file: " << path << std::endl;
+    return false;
+  }
+
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    buffers = buffers_;
+  }
+
+  // Chrome trace format: complete events ("X") with timestamps in microseconds
+  std::size_t count = 0;
+  file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+  for (const auto & buffer : buffers) {
+    std::lock_guard<std::mutex> lock(buffer->mutex);
+    const std::size_t size = buffer->wrapped ? buffer->events.size() : buffer->next;
+    const std::size_t first = buffer->wrapped ? buffer->next : 0;
+    for (std::size_t i = 0; i < size; ++i) {
+      const auto & event = buffer->events[(first + i) % buffer->events.size()];
+      file << (count++ ? ",\n" : "\n")
+           << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid
+           << ",\"ts\":" << event.start_ns / 1e3 << ",\"dur\":" << event.duration_ns / 1e3 << "}";
+    }
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+  std::cout << "Dumped " << count << " trace spans to " << path << std::endl;
+  return true;
+}
+
+std::int64_t Tracer::now_ns()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+Tracer::ThreadBuffer & Tracer::thread_buffer()
+{
+  if (thread_owner != this || !thread_buffer_ptr) {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->events.resize(capacity_);
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    buffer->tid = static_cast<std::uint32_t>(buffers_.size() + 1);
+    buffers_.push_back(buffer);
+    thread_owner = this;
+    thread_buffer_ptr = buffer;
+  }
+  return *static_cast<ThreadBuffer *>(thread_buffer_ptr.get());
+}
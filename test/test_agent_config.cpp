@@ -0,0 +1,137 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mqtt_dsr_agent/agent_config.hpp"
+
+using namespace std::chrono_literals;
+
+class AgentConfigTest : public ::testing::Test
+{
+protected:
+  AgentConfigTest()
+  : dir_(std::filesystem::temp_directory_path() /
+      ("test_agent_config_" +
+      std::string(::testing::UnitTest::GetInstance()->current_test_info()->name())))
+  {
+    std::filesystem::create_directories(dir_);
+  }
+
+  ~AgentConfigTest() override
+  {
+    std::filesystem::remove_all(dir_);
+  }
+
+  // Write a config file with the given content and load it
+  std::shared_ptr<const AgentConfig> load(const std::string & content)
+  {
+    const auto path = dir_ / "config";
+    std::ofstream(path) << content;
+    return load_configuration(path.string());
+  }
+
+  std::filesystem::path dir_;
+};
+
+TEST_F(AgentConfigTest, ParsesBasicParameters)
+{
+  auto config = load(
+    "# Comment\n"
+    "\n"
+    "agent_id=42\n"
+    "agent_name=mqtt_agent\n"
+    "server_address=mqtt://localhost:1883\n"
+    "topic=avispa/a\n"
+    "topics=avispa/b,avispa/c\n"
+    "snapshot_period=250\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config->agent_id, 42);
+  EXPECT_EQ(config->agent_name, "mqtt_agent");
+  EXPECT_EQ(config->server_address, "mqtt://localhost:1883");
+  EXPECT_EQ(config->topics, (std::vector<std::string>{"avispa/a", "avispa/b", "avispa/c"}));
+  EXPECT_EQ(config->snapshot_period, 250ms);
+}
+
+TEST_F(AgentConfigTest, ParsesStaleTimeouts)
+{
+  auto config = load(
+    "stale_timeout=60\n"
+    "stale_timeout.PIR=10\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config->stale_timeout("PIR"), 10s);
+  EXPECT_EQ(config->stale_timeout("Contact"), 60s);
+}
+
+TEST_F(AgentConfigTest, StaleTimeoutDisabledByDefault)
+{
+  auto config = load("stale_timeout.PIR=10\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config->stale_timeout("PIR"), 10s);
+  EXPECT_EQ(config->stale_timeout("Contact"), 0ms);
+}
+
+TEST_F(AgentConfigTest, ParsesSensorTypes)
+{
+  auto config = load("sensor_type.datoRadarRespiracion=vital_signs\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config->sensor_type("datoRadarRespiracion"), "vital_signs");
+  EXPECT_EQ(config->sensor_type("PIR"), "PIR");
+}
+
+TEST_F(AgentConfigTest, ParsesThresholds)
+{
+  auto config = load("threshold.heartrate=120.5\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_FLOAT_EQ(config->threshold("heartrate", 0.0f), 120.5f);
+  EXPECT_FLOAT_EQ(config->threshold("breathrate", 30.0f), 30.0f);
+}
+
+TEST_F(AgentConfigTest, ResolvesTopologyFileFromConfigDirectory)
+{
+  auto config = load("topology_file=topology.json\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config->topology_file, (dir_ / "topology.json").string());
+
+  config = load("topology_file=/etc/topology.json\n");
+  ASSERT_NE(config, nullptr);
+  EXPECT_EQ(config->topology_file, "/etc/topology.json");
+}
+
+TEST_F(AgentConfigTest, RejectsUnknownParameters)
+{
+  EXPECT_EQ(load("unknown=1\n"), nullptr);
+  // The prefixed parameters need a suffix
+  EXPECT_EQ(load("sensor_type=PIR\n"), nullptr);
+  EXPECT_EQ(load("threshold=1.0\n"), nullptr);
+}
+
+TEST_F(AgentConfigTest, RejectsInvalidValues)
+{
+  EXPECT_EQ(load("agent_id=abc\n"), nullptr);
+  EXPECT_EQ(load("stale_timeout.PIR=\n"), nullptr);
+  EXPECT_EQ(load("threshold.heartrate=high\n"), nullptr);
+}
+
+TEST_F(AgentConfigTest, RejectsMissingFile)
+{
+  EXPECT_EQ(load_configuration((dir_ / "missing").string()), nullptr);
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2025 Alberto J. Tudela Roldán
+// Copyright (c) 2025 José Galeas Merchán
+// Copyright (c) 2025 Grupo Avispa, DTE, Universidad de Málaga
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "mqtt_dsr_agent/timing_wheel.hpp"
+
+using namespace std::chrono_literals;
+
+class TimingWheelTest : public ::testing::Test
+{
+protected:
+  TimingWheelTest()
+  : wheel_(TICK), start_(std::chrono::steady_clock::now()) {}
+
+  // Advance the wheel to the given number of ticks after its creation
+  std::vector<std::string> advance_to(std::uint64_t ticks)
+  {
+    return wheel_.advance(start_ + ticks * TICK);
+  }
+
+  static constexpr std::chrono::milliseconds TICK{100};
+  TimingWheel wheel_;
+  std::chrono::steady_clock::time_point start_;
+};
+
+TEST_F(TimingWheelTest, ExpiresAfterTimeout)
+{
+  wheel_.schedule("sensor", 5 * TICK);
+  EXPECT_TRUE(wheel_.contains("sensor"));
+  EXPECT_EQ(wheel_.size(), 1u);
+
+  EXPECT_TRUE(advance_to(4).empty());
+  EXPECT_EQ(advance_to(5), std::vector<std::string>{"sensor"});
+  EXPECT_FALSE(wheel_.contains("sensor"));
+  EXPECT_EQ(wheel_.size(), 0u);
+  EXPECT_TRUE(advance_to(100).empty());
+}
+
+TEST_F(TimingWheelTest, RoundsUpToWholeTicks)
+{
+  wheel_.schedule("zero", 0ms);
+  wheel_.schedule("partial", TICK + 1ms);
+
+  EXPECT_EQ(advance_to(1), std::vector<std::string>{"zero"});
+  EXPECT_EQ(advance_to(2), std::vector<std::string>{"partial"});
+}
+
+TEST_F(TimingWheelTest, RescheduleMovesDeadline)
+{
+  wheel_.schedule("sensor", 5 * TICK);
+  EXPECT_TRUE(advance_to(3).empty());
+  // The new deadline counts from the current tick
+  wheel_.schedule("sensor", 5 * TICK);
+  EXPECT_EQ(wheel_.size(), 1u);
+
+  EXPECT_TRUE(advance_to(7).empty());
+  EXPECT_EQ(advance_to(8), std::vector<std::string>{"sensor"});
+}
+
+TEST_F(TimingWheelTest, CancelRemovesDeadline)
+{
+  wheel_.schedule("sensor", 5 * TICK);
+  wheel_.schedule("other", 5 * TICK);
+
+  EXPECT_TRUE(wheel_.cancel("sensor"));
+  EXPECT_FALSE(wheel_.cancel("sensor"));
+  EXPECT_FALSE(wheel_.contains("sensor"));
+  EXPECT_EQ(advance_to(5), std::vector<std::string>{"other"});
+  EXPECT_FALSE(wheel_.cancel("other"));
+}
+
+TEST_F(TimingWheelTest, ExpiresAcrossLevelBoundaries)
+{
+  // Deadlines on the first, second and third levels of the wheel
+  const std::vector<std::uint64_t> deadlines = {63, 64, 65, 100, 4095, 4096, 4097, 5000};
+  for (auto ticks : deadlines) {
+    wheel_.schedule(std::to_string(ticks), ticks * TICK);
+  }
+
+  for (auto ticks : deadlines) {
+    EXPECT_TRUE(advance_to(ticks - 1).empty()) << "before tick " << ticks;
+    EXPECT_EQ(advance_to(ticks), std::vector<std::string>{std::to_string(ticks)});
+  }
+  EXPECT_EQ(wheel_.size(), 0u);
+}
+
+TEST_F(TimingWheelTest, ExpiresAcrossLevelBoundariesFromUnalignedTick)
+{
+  // Scheduled when the lowest level is not at slot zero
+  EXPECT_TRUE(advance_to(60).empty());
+  wheel_.schedule("level1", 10 * TICK);
+  wheel_.schedule("level2", 4090 * TICK);
+
+  EXPECT_TRUE(advance_to(69).empty());
+  EXPECT_EQ(advance_to(70), std::vector<std::string>{"level1"});
+  EXPECT_TRUE(advance_to(4149).empty());
+  EXPECT_EQ(advance_to(4150), std::vector<std::string>{"level2"});
+}
+
+TEST_F(TimingWheelTest, AdvanceExpiresSeveralTicksAtOnce)
+{
+  wheel_.schedule("first", 10 * TICK);
+  wheel_.schedule("second", 200 * TICK);
+  wheel_.schedule("third", 300 * TICK);
+
+  EXPECT_EQ(advance_to(250), (std::vector<std::string>{"first", "second"}));
+  EXPECT_TRUE(wheel_.contains("third"));
+  EXPECT_EQ(advance_to(300), std::vector<std::string>{"third"});
+}